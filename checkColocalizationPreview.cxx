@@ -0,0 +1,240 @@
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkColocalizationImageFilter.h"
+#include <algorithm>
+
+const int dim = 2;
+typedef unsigned char PType;
+typedef itk::Image< PType, dim > IType;
+typedef itk::ColocalizationImageFilter< IType > ColocType;
+
+bool inside( const char * name, ColocType::MeasurementType value,
+             ColocType::MeasurementType lower, ColocType::MeasurementType upper )
+{
+  std::cout << name << ": " << value << " in [" << lower << ", " << upper << "]" << std::endl;
+  if( !( value >= lower && value <= upper ) )
+    {
+    std::cerr << name << " is not in the confidence interval." << std::endl;
+    return false;
+    }
+  return true;
+}
+
+// NaN, computed on an empty histogram, is equal to itself here
+bool same( ColocType::MeasurementType a, ColocType::MeasurementType b )
+{
+  return a == b || ( a != a && b != b );
+}
+
+bool exact( const char * name, ColocType::MeasurementType value,
+            ColocType::MeasurementType lower, ColocType::MeasurementType upper )
+{
+  std::cout << name << ": " << value << " in [" << lower << ", " << upper << "]" << std::endl;
+  if( !same( lower, value ) || !same( upper, value ) )
+    {
+    std::cerr << "The bounds of " << name << " are not the exact value." << std::endl;
+    return false;
+    }
+  return true;
+}
+
+bool checkSampledVoxels( const char * name, ColocType * filter, unsigned long expected )
+{
+  if( filter->GetNumberOfSampledVoxels() != expected )
+    {
+    std::cerr << "Wrong number of sampled voxels " << name << ": " << filter->GetNumberOfSampledVoxels()
+              << " instead of " << expected << std::endl;
+    return false;
+    }
+  return true;
+}
+
+IType::Pointer makeMask( const IType * image, PType value )
+{
+  IType::Pointer mask = IType::New();
+  mask->SetRegions( image->GetLargestPossibleRegion() );
+  mask->Allocate();
+  mask->FillBuffer( value );
+  return mask;
+}
+
+int main(int argc, char * argv[])
+{
+
+  if( argc != 4 )
+    {
+    std::cerr << "usage: " << argv[0] << " channel1 channel2 mask" << std::endl;
+    exit(1);
+    }
+
+  typedef itk::ImageFileReader< IType > ReaderType;
+
+  ReaderType::Pointer reader1 = ReaderType::New();
+  reader1->SetFileName( argv[1] );
+  reader1->Update();
+
+  ReaderType::Pointer reader2 = ReaderType::New();
+  reader2->SetFileName( argv[2] );
+
+  ReaderType::Pointer reader3 = ReaderType::New();
+  reader3->SetFileName( argv[3] );
+  reader3->Update();
+
+  const unsigned long numberOfPixels = reader1->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  // the threshold is fixed, so the coefficients of both runs are comparable
+  ColocType::MeasurementVectorType t;
+  t.Fill( 50 );
+  ColocType::HistogramSizeType s;
+  s.Fill( 64 );
+  const unsigned long budget = 20000;
+
+  ColocType::Pointer exactColoc = ColocType::New();
+  exactColoc->SetInput( 0, reader1->GetOutput() );
+  exactColoc->SetInput( 1, reader2->GetOutput() );
+  exactColoc->SetNumberOfBins( s );
+  exactColoc->SetThreshold( t );
+  exactColoc->SetComputeThreshold( false );
+  exactColoc->Update();
+
+  // analytic intervals
+  ColocType::Pointer preview = ColocType::New();
+  preview->SetInput( 0, reader1->GetOutput() );
+  preview->SetInput( 1, reader2->GetOutput() );
+  preview->SetNumberOfBins( s );
+  preview->SetThreshold( t );
+  preview->SetComputeThreshold( false );
+  preview->PreviewOn();
+  preview->SetNumberOfSamples( budget );
+  preview->SetSeed( 42 );
+  preview->SetConfidenceLevel( 0.99 );
+  preview->Update();
+
+  if( !checkSampledVoxels( "with a budget", preview, budget ) )
+    {
+    return EXIT_FAILURE;
+    }
+  if( !inside( "Pearson", exactColoc->GetPearson(), preview->GetPearsonLowerBound(), preview->GetPearsonUpperBound() )
+      || !inside( "Contribution1", exactColoc->GetContribution1(), preview->GetContribution1LowerBound(), preview->GetContribution1UpperBound() )
+      || !inside( "Contribution2", exactColoc->GetContribution2(), preview->GetContribution2LowerBound(), preview->GetContribution2UpperBound() ) )
+    {
+    return EXIT_FAILURE;
+    }
+  if( preview->GetThresholdBoundsAvailable() )
+    {
+    std::cerr << "Threshold bounds should not be available with analytic intervals." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // number of samples given as a fraction of the voxels
+  preview->SetNumberOfSamples( 0 );
+  preview->SetSampleFraction( 0.05 );
+  preview->Update();
+  if( !checkSampledVoxels( "with a fraction", preview,
+                           static_cast< unsigned long >( vcl_ceil( 0.05 * numberOfPixels ) ) ) )
+    {
+    return EXIT_FAILURE;
+    }
+  preview->SetNumberOfSamples( budget );
+
+  // with a mask covering the whole image, no voxel is rejected
+  IType::Pointer fullMask = makeMask( reader1->GetOutput(), 255 );
+  preview->SetMaskImage( fullMask );
+  preview->Update();
+  if( !checkSampledVoxels( "in a full mask", preview, budget ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // with a partial mask, the voxels out of the mask are rejected. The budget
+  // is never exceeded, and is reached if the mask is large enough to expect
+  // twice the budget in the maximum number of draws.
+  unsigned long maskSize = 0;
+  itk::ImageRegionConstIterator< IType > mit( reader3->GetOutput(), reader3->GetOutput()->GetBufferedRegion() );
+  for( mit.GoToBegin(); !mit.IsAtEnd(); ++mit )
+    {
+    if( mit.Get() == preview->GetMaskValue() )
+      {
+      maskSize++;
+      }
+    }
+
+  preview->SetMaskImage( reader3->GetOutput() );
+  preview->Update();
+  std::cout << "Sampled voxels in the mask: " << preview->GetNumberOfSampledVoxels()
+            << " (mask size: " << maskSize << ")" << std::endl;
+  if( preview->GetNumberOfSampledVoxels() > std::min( budget, maskSize )
+      || ( maskSize > 0 && preview->GetNumberOfSampledVoxels() == 0 ) )
+    {
+    std::cerr << "Wrong number of sampled voxels in the mask." << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( maskSize * preview->GetMaximumNumberOfDrawsPerSample() >= 2 * numberOfPixels
+      && !checkSampledVoxels( "in the mask", preview, budget ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // with an empty mask, the exact computation is done
+  IType::Pointer emptyMask = makeMask( reader1->GetOutput(), 0 );
+  preview->SetMaskImage( emptyMask );
+  preview->Update();
+  if( !checkSampledVoxels( "in an empty mask", preview, 0 ) )
+    {
+    return EXIT_FAILURE;
+    }
+  if( !exact( "Pearson", preview->GetPearson(), preview->GetPearsonLowerBound(), preview->GetPearsonUpperBound() )
+      || !exact( "Contribution1", preview->GetContribution1(), preview->GetContribution1LowerBound(), preview->GetContribution1UpperBound() )
+      || !exact( "Contribution2", preview->GetContribution2(), preview->GetContribution2LowerBound(), preview->GetContribution2UpperBound() )
+      || !exact( "Threshold0", preview->GetThreshold()[0], preview->GetThresholdLowerBound()[0], preview->GetThresholdUpperBound()[0] )
+      || !exact( "Threshold1", preview->GetThreshold()[1], preview->GetThresholdLowerBound()[1], preview->GetThresholdUpperBound()[1] ) )
+    {
+    return EXIT_FAILURE;
+    }
+  if( !preview->GetThresholdBoundsAvailable() )
+    {
+    std::cerr << "Threshold bounds should be available with the exact computation." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // bootstrap intervals, including the threshold one. A few bins and
+  // replicates keep the threshold searches fast.
+  ColocType::HistogramSizeType smallS;
+  smallS.Fill( 16 );
+  ColocType::Pointer bootstrap = ColocType::New();
+  bootstrap->SetInput( 0, reader1->GetOutput() );
+  bootstrap->SetInput( 1, reader2->GetOutput() );
+  bootstrap->SetNumberOfBins( smallS );
+  bootstrap->PreviewOn();
+  bootstrap->SetNumberOfSamples( 5000 );
+  bootstrap->SetNumberOfBootstrapReplicates( 20 );
+  bootstrap->SetSeed( 42 );
+  bootstrap->Update();
+
+  if( !checkSampledVoxels( "with bootstrap", bootstrap, 5000 ) )
+    {
+    return EXIT_FAILURE;
+    }
+  if( !bootstrap->GetThresholdBoundsAvailable() )
+    {
+    std::cerr << "Threshold bounds should be available with bootstrap intervals." << std::endl;
+    return EXIT_FAILURE;
+    }
+  for( unsigned int i=0; i<2; i++ )
+    {
+    if( !( bootstrap->GetThresholdLowerBound()[i] <= bootstrap->GetThresholdUpperBound()[i] ) )
+      {
+      std::cerr << "Wrong threshold bounds: " << bootstrap->GetThresholdLowerBound()
+                << " " << bootstrap->GetThresholdUpperBound() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if( !inside( "Bootstrap Pearson upper bound", bootstrap->GetPearsonUpperBound(), bootstrap->GetPearsonLowerBound(), 1 )
+      || !inside( "Bootstrap Contribution1 upper bound", bootstrap->GetContribution1UpperBound(), bootstrap->GetContribution1LowerBound(), 1 )
+      || !inside( "Bootstrap Contribution2 upper bound", bootstrap->GetContribution2UpperBound(), bootstrap->GetContribution2LowerBound(), 1 ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
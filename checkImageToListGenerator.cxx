@@ -0,0 +1,107 @@
+#include "itkImage.h"
+#include "itkVector.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageToListGenerator.h"
+
+// build the list from the image with several threads, and compare it to a
+// serial iteration over the image
+template< class TGenerator, class TImage, class TMaskImage >
+int checkList( TGenerator * generator, const TImage * image, const TMaskImage * mask )
+{
+  typedef typename TGenerator::ListSampleType ListSampleType;
+  const ListSampleType * list = generator->GetListSample();
+
+  typename ListSampleType::InstanceIdentifier id = 0;
+  itk::ImageRegionConstIterator< TImage > it( image, image->GetBufferedRegion() );
+  itk::ImageRegionConstIterator< TMaskImage > mit( mask, mask->GetBufferedRegion() );
+  for( it.GoToBegin(), mit.GoToBegin(); !it.IsAtEnd(); ++it, ++mit )
+    {
+    if( generator->GetMaskImage() && mit.Get() != generator->GetMaskValue() )
+      {
+      continue;
+      }
+    if( id >= list->Size() )
+      {
+      std::cerr << "List too short: " << list->Size() << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( list->GetMeasurementVector( id ) != it.Get() )
+      {
+      std::cerr << "Wrong value at " << id << ": " << list->GetMeasurementVector( id )
+                << " instead of " << it.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    id++;
+    }
+  if( id != list->Size() )
+    {
+    std::cerr << "Wrong list size: " << list->Size() << " instead of " << id << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+int main(int, char * [])
+{
+  const int dim = 3;
+
+  // the measurement vectors of a list sample are arrays, as in
+  // ColocalizationImageFilter where the two channels are composed
+  typedef itk::Vector< unsigned short, 2 > PType;
+  typedef itk::Image< PType, dim > IType;
+  typedef unsigned char MType;
+  typedef itk::Image< MType, dim > MaskType;
+
+  IType::SizeType size;
+  size[0] = 17;
+  size[1] = 13;
+  size[2] = 11;
+
+  IType::Pointer image = IType::New();
+  image->SetRegions( size );
+  image->Allocate();
+  MaskType::Pointer mask = MaskType::New();
+  mask->SetRegions( size );
+  mask->Allocate();
+
+  // all the pixels are different, and the mask is irregular
+  unsigned short v = 0;
+  PType p;
+  itk::ImageRegionIterator< IType > it( image, image->GetBufferedRegion() );
+  itk::ImageRegionIterator< MaskType > mit( mask, mask->GetBufferedRegion() );
+  for( it.GoToBegin(), mit.GoToBegin(); !it.IsAtEnd(); ++it, ++mit )
+    {
+    p[0] = v;
+    p[1] = 3 * v;
+    it.Set( p );
+    mit.Set( ( v * 7 ) % 5 < 2 ? 255 : 0 );
+    v++;
+    }
+
+  typedef itk::Statistics::ImageToListGenerator< IType, MaskType > GeneratorType;
+
+  // without mask
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->SetInput( image );
+  generator->SetNumberOfThreads( 4 );
+  generator->Update();
+  if( checkList( generator.GetPointer(), image.GetPointer(), mask.GetPointer() ) == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // with mask
+  GeneratorType::Pointer maskedGenerator = GeneratorType::New();
+  maskedGenerator->SetInput( image );
+  maskedGenerator->SetMaskImage( mask );
+  maskedGenerator->SetMaskValue( 255 );
+  maskedGenerator->SetNumberOfThreads( 4 );
+  maskedGenerator->Update();
+  if( checkList( maskedGenerator.GetPointer(), image.GetPointer(), mask.GetPointer() ) == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,347 @@
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkObjectColocalizationImageFilter.h"
+#include "itkColocalizationImageFilter.h"
+
+typedef unsigned char PType;
+typedef itk::Image< PType, 2 > IType;
+typedef itk::Image< PType, 3 > IType3;
+
+typedef std::vector< unsigned long > SizeVectorType;
+typedef std::pair< unsigned long, unsigned long > LabelPairType;
+typedef std::map< LabelPairType, unsigned long > OverlapMapType;
+
+// the results of a run of the filter
+struct Result
+{
+  unsigned long NumberOfObjects1;
+  unsigned long NumberOfObjects2;
+  unsigned long NumberOfColocalizedObjects1;
+  unsigned long NumberOfColocalizedObjects2;
+  double ObjectOverlap1;
+  double ObjectOverlap2;
+  double ObjectContribution1;
+  double ObjectContribution2;
+  SizeVectorType ObjectSizes1;
+  SizeVectorType ObjectSizes2;
+  OverlapMapType OverlapAreas;
+};
+
+template< class TImage >
+Result run( TImage * image1, TImage * image2, TImage * mask, bool fullyConnected, int numberOfThreads )
+{
+  typedef itk::ObjectColocalizationImageFilter< TImage > FilterType;
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( 0, image1 );
+  filter->SetInput( 1, image2 );
+  if( mask )
+    {
+    filter->SetMaskImage( mask );
+    filter->SetMaskValue( 255 );
+    }
+  // the threshold of ColocalizationImageFilter can be used directly
+  typename itk::ColocalizationImageFilter< TImage >::MeasurementVectorType t;
+  t.Fill( 50 );
+  filter->SetThreshold( t );
+  filter->SetFullyConnected( fullyConnected );
+  filter->SetNumberOfThreads( numberOfThreads );
+  filter->Update();
+
+  Result r;
+  r.NumberOfObjects1 = filter->GetNumberOfObjects1();
+  r.NumberOfObjects2 = filter->GetNumberOfObjects2();
+  r.NumberOfColocalizedObjects1 = filter->GetNumberOfColocalizedObjects1();
+  r.NumberOfColocalizedObjects2 = filter->GetNumberOfColocalizedObjects2();
+  r.ObjectOverlap1 = filter->GetObjectOverlap1();
+  r.ObjectOverlap2 = filter->GetObjectOverlap2();
+  r.ObjectContribution1 = filter->GetObjectContribution1();
+  r.ObjectContribution2 = filter->GetObjectContribution2();
+  r.ObjectSizes1 = filter->GetObjectSizes1();
+  r.ObjectSizes2 = filter->GetObjectSizes2();
+  r.OverlapAreas = filter->GetOverlapAreas();
+  return r;
+}
+
+bool close( double v1, double v2 )
+{
+  return vcl_fabs( v1 - v2 ) < 1e-12;
+}
+
+bool same( const Result & r1, const Result & r2 )
+{
+  return r1.NumberOfObjects1 == r2.NumberOfObjects1
+    && r1.NumberOfObjects2 == r2.NumberOfObjects2
+    && r1.NumberOfColocalizedObjects1 == r2.NumberOfColocalizedObjects1
+    && r1.NumberOfColocalizedObjects2 == r2.NumberOfColocalizedObjects2
+    && close( r1.ObjectOverlap1, r2.ObjectOverlap1 )
+    && close( r1.ObjectOverlap2, r2.ObjectOverlap2 )
+    && close( r1.ObjectContribution1, r2.ObjectContribution1 )
+    && close( r1.ObjectContribution2, r2.ObjectContribution2 )
+    && r1.ObjectSizes1 == r2.ObjectSizes1
+    && r1.ObjectSizes2 == r2.ObjectSizes2
+    && r1.OverlapAreas == r2.OverlapAreas;
+}
+
+template< class TImage >
+typename TImage::Pointer makeImage( const typename TImage::SizeType & size, PType value )
+{
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions( size );
+  image->Allocate();
+  image->FillBuffer( value );
+  return image;
+}
+
+// run the filter with several numbers of threads, so the objects cross the
+// strip borders in various ways
+template< class TImage >
+bool check( const char * name, TImage * image1, TImage * image2, TImage * mask,
+            const Result & full, const Result & face )
+{
+  int threads[] = { 1, 2, 3, 4, 7, 16 };
+  for( unsigned int i=0; i<sizeof(threads)/sizeof(int); i++ )
+    {
+    if( !same( run( image1, image2, mask, true, threads[i] ), full ) )
+      {
+      std::cerr << "Wrong result " << name << " with FullyConnectedOn and " << threads[i] << " threads." << std::endl;
+      return false;
+      }
+    if( !same( run( image1, image2, mask, false, threads[i] ), face ) )
+      {
+      std::cerr << "Wrong result " << name << " with FullyConnectedOff and " << threads[i] << " threads." << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+int main(int, char * [])
+{
+  IType::SizeType size;
+  size[0] = 80;
+  size[1] = 64;
+
+  IType::Pointer image1 = makeImage< IType >( size, 0 );
+  IType::Pointer image2 = makeImage< IType >( size, 0 );
+
+  // channel 1: a vertical bar and a diagonal line, both crossing all the
+  // strip borders, a shorter anti-diagonal line, and a small rectangle. The
+  // lines are connected only with FullyConnectedOn.
+  IType::IndexType idx;
+  for( idx[1]=0; idx[1]<64; idx[1]++ )
+    {
+    for( idx[0]=2; idx[0]<=4; idx[0]++ )
+      {
+      image1->SetPixel( idx, 100 );
+      }
+    idx[0] = 10 + idx[1];
+    image1->SetPixel( idx, 100 );
+    if( idx[1] <= 20 )
+      {
+      idx[0] = 75 - idx[1];
+      image1->SetPixel( idx, 100 );
+      }
+    }
+  for( idx[1]=50; idx[1]<=52; idx[1]++ )
+    {
+    for( idx[0]=40; idx[0]<=44; idx[0]++ )
+      {
+      image1->SetPixel( idx, 100 );
+      }
+    }
+
+  // channel 2: a small square, and a horizontal bar across the vertical bar
+  // and the diagonal line of channel 1
+  for( idx[1]=0; idx[1]<=5; idx[1]++ )
+    {
+    for( idx[0]=60; idx[0]<=69; idx[0]++ )
+      {
+      image2->SetPixel( idx, 100 );
+      }
+    }
+  for( idx[1]=30; idx[1]<=33; idx[1]++ )
+    {
+    for( idx[0]=0; idx[0]<80; idx[0]++ )
+      {
+      image2->SetPixel( idx, 100 );
+      }
+    }
+
+  // expected values. The labels are given in the raster order of the first
+  // pixel of the objects.
+  Result full;
+  full.NumberOfObjects1 = 4;
+  full.NumberOfObjects2 = 2;
+  full.NumberOfColocalizedObjects1 = 2;
+  full.NumberOfColocalizedObjects2 = 1;
+  full.ObjectOverlap1 = 0.5;
+  full.ObjectOverlap2 = 0.5;
+  full.ObjectContribution1 = 256 / 292.0;
+  full.ObjectContribution2 = 320 / 380.0;
+  full.ObjectSizes1.push_back( 0 );
+  full.ObjectSizes1.push_back( 192 );
+  full.ObjectSizes1.push_back( 64 );
+  full.ObjectSizes1.push_back( 21 );
+  full.ObjectSizes1.push_back( 15 );
+  full.ObjectSizes2.push_back( 0 );
+  full.ObjectSizes2.push_back( 60 );
+  full.ObjectSizes2.push_back( 320 );
+  full.OverlapAreas[ LabelPairType( 1, 2 ) ] = 12;
+  full.OverlapAreas[ LabelPairType( 2, 2 ) ] = 4;
+
+  // each pixel of the lines is an object. Label 73 is the rectangle.
+  Result face = full;
+  face.NumberOfObjects1 = 87;
+  face.NumberOfColocalizedObjects1 = 5;
+  face.ObjectOverlap1 = 5 / 87.0;
+  face.ObjectContribution1 = 196 / 292.0;
+  face.ObjectSizes1.assign( 88, 1 );
+  face.ObjectSizes1[0] = 0;
+  face.ObjectSizes1[1] = 192;
+  face.ObjectSizes1[73] = 15;
+  face.OverlapAreas.clear();
+  face.OverlapAreas[ LabelPairType( 1, 2 ) ] = 12;
+  for( unsigned long l=53; l<=56; l++ )
+    {
+    face.OverlapAreas[ LabelPairType( l, 2 ) ] = 1;
+    }
+
+  if( !check< IType >( "in 2D", image1, image2, 0, full, face ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // with a mask hiding the right part of the image: the square and the
+  // anti-diagonal line are removed, and the other objects are cut
+  IType::Pointer mask = makeImage< IType >( size, 255 );
+  for( idx[1]=0; idx[1]<64; idx[1]++ )
+    {
+    for( idx[0]=50; idx[0]<80; idx[0]++ )
+      {
+      mask->SetPixel( idx, 0 );
+      }
+    }
+
+  Result maskedFull;
+  maskedFull.NumberOfObjects1 = 3;
+  maskedFull.NumberOfObjects2 = 1;
+  maskedFull.NumberOfColocalizedObjects1 = 2;
+  maskedFull.NumberOfColocalizedObjects2 = 1;
+  maskedFull.ObjectOverlap1 = 2 / 3.0;
+  maskedFull.ObjectOverlap2 = 1;
+  maskedFull.ObjectContribution1 = 232 / 247.0;
+  maskedFull.ObjectContribution2 = 1;
+  maskedFull.ObjectSizes1.push_back( 0 );
+  maskedFull.ObjectSizes1.push_back( 192 );
+  maskedFull.ObjectSizes1.push_back( 40 );
+  maskedFull.ObjectSizes1.push_back( 15 );
+  maskedFull.ObjectSizes2.push_back( 0 );
+  maskedFull.ObjectSizes2.push_back( 200 );
+  maskedFull.OverlapAreas[ LabelPairType( 1, 1 ) ] = 12;
+  maskedFull.OverlapAreas[ LabelPairType( 2, 1 ) ] = 4;
+
+  // label 42 is the rectangle
+  Result maskedFace = maskedFull;
+  maskedFace.NumberOfObjects1 = 42;
+  maskedFace.NumberOfColocalizedObjects1 = 5;
+  maskedFace.ObjectOverlap1 = 5 / 42.0;
+  maskedFace.ObjectContribution1 = 196 / 247.0;
+  maskedFace.ObjectSizes1.assign( 43, 1 );
+  maskedFace.ObjectSizes1[0] = 0;
+  maskedFace.ObjectSizes1[1] = 192;
+  maskedFace.ObjectSizes1[42] = 15;
+  maskedFace.OverlapAreas.clear();
+  maskedFace.OverlapAreas[ LabelPairType( 1, 1 ) ] = 12;
+  for( unsigned long l=32; l<=35; l++ )
+    {
+    maskedFace.OverlapAreas[ LabelPairType( l, 1 ) ] = 1;
+    }
+
+  if( !check< IType >( "with a mask", image1, image2, mask, maskedFull, maskedFace ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // a small 3D image, split along z
+  IType3::SizeType size3;
+  size3[0] = 12;
+  size3[1] = 10;
+  size3[2] = 16;
+
+  IType3::Pointer image31 = makeImage< IType3 >( size3, 0 );
+  IType3::Pointer image32 = makeImage< IType3 >( size3, 0 );
+
+  // channel 1: a zigzag line connected only by the vertices of its voxels, a
+  // column, and a short column in the last layers
+  IType3::IndexType idx3;
+  for( idx3[2]=0; idx3[2]<16; idx3[2]++ )
+    {
+    idx3[0] = 2 + idx3[2] % 2;
+    idx3[1] = 3 + idx3[2] % 2;
+    image31->SetPixel( idx3, 100 );
+    idx3[0] = 8;
+    idx3[1] = 8;
+    image31->SetPixel( idx3, 100 );
+    if( idx3[2] >= 12 )
+      {
+      idx3[0] = 5;
+      idx3[1] = 0;
+      image31->SetPixel( idx3, 100 );
+      }
+    // channel 2: a column, and a slab in the middle layers
+    idx3[0] = 11;
+    idx3[1] = 0;
+    image32->SetPixel( idx3, 100 );
+    if( idx3[2] == 7 || idx3[2] == 8 )
+      {
+      for( idx3[1]=0; idx3[1]<10; idx3[1]++ )
+        {
+        for( idx3[0]=0; idx3[0]<10; idx3[0]++ )
+          {
+          image32->SetPixel( idx3, 100 );
+          }
+        }
+      }
+    }
+
+  Result full3;
+  full3.NumberOfObjects1 = 3;
+  full3.NumberOfObjects2 = 2;
+  full3.NumberOfColocalizedObjects1 = 2;
+  full3.NumberOfColocalizedObjects2 = 1;
+  full3.ObjectOverlap1 = 2 / 3.0;
+  full3.ObjectOverlap2 = 0.5;
+  full3.ObjectContribution1 = 32 / 36.0;
+  full3.ObjectContribution2 = 200 / 216.0;
+  full3.ObjectSizes1.push_back( 0 );
+  full3.ObjectSizes1.push_back( 16 );
+  full3.ObjectSizes1.push_back( 16 );
+  full3.ObjectSizes1.push_back( 4 );
+  full3.ObjectSizes2.push_back( 0 );
+  full3.ObjectSizes2.push_back( 16 );
+  full3.ObjectSizes2.push_back( 200 );
+  full3.OverlapAreas[ LabelPairType( 1, 2 ) ] = 2;
+  full3.OverlapAreas[ LabelPairType( 2, 2 ) ] = 2;
+
+  // each voxel of the zigzag line is an object. Label 14 is the short column.
+  Result face3 = full3;
+  face3.NumberOfObjects1 = 18;
+  face3.NumberOfColocalizedObjects1 = 3;
+  face3.ObjectOverlap1 = 3 / 18.0;
+  face3.ObjectContribution1 = 18 / 36.0;
+  face3.ObjectSizes1.assign( 19, 1 );
+  face3.ObjectSizes1[0] = 0;
+  face3.ObjectSizes1[2] = 16;
+  face3.ObjectSizes1[14] = 4;
+  face3.OverlapAreas.clear();
+  face3.OverlapAreas[ LabelPairType( 2, 2 ) ] = 2;
+  face3.OverlapAreas[ LabelPairType( 9, 2 ) ] = 1;
+  face3.OverlapAreas[ LabelPairType( 10, 2 ) ] = 1;
+
+  if( !check< IType3 >( "in 3D", image31, image32, 0, full3, face3 ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -25,11 +25,40 @@
 #include "itkImageToHistogramGenerator.h"
 #include "itkHistogramToLogProbabilityImageFilter.h"
 #include "itkRescaleIntensityImageFilter.h"
+#include <vector>
 
 namespace itk {
 
 /** \class ColocalizationImageFilter 
  *
+ * In preview mode, the joint histogram is built from a stratified subsample
+ * of the voxels instead of the whole image: the image is divided in as many
+ * consecutive blocks of voxels as requested samples, and one voxel is drawn
+ * at random in each block. The computation time then depends on the number
+ * of samples and not on the size of the image. The number of samples is
+ * given either as a fraction of the number of voxels with SetSampleFraction(),
+ * or directly with SetNumberOfSamples(). When a mask is used, the voxels drawn
+ * out of the mask are rejected, and new voxels are drawn over the whole image
+ * until the number of samples is reached, or until
+ * MaximumNumberOfDrawsPerSample times the number of samples have been drawn.
+ * The mask is never read entirely: NumberOfSampledVoxels is lower than the
+ * number of samples if the mask is too small to reach it. If no voxel is
+ * found in the mask, the exact computation is done.
+ *
+ * The histogram covers the range of the pixel type in both modes, so the
+ * bins, and the coefficients computed on them, are the same with and without
+ * preview. With a floating point pixel type, the range of the input images
+ * is used instead.
+ *
+ * Confidence intervals are computed for Pearson, Contribution1,
+ * Contribution2 (the Manders coefficients) and the threshold in preview mode.
+ * By default, the intervals are analytic: Fisher's z transform for Pearson,
+ * and the delta method, on the bins of the sampled histogram, for the Manders
+ * coefficients. The threshold has no analytic interval: its bounds are set
+ * to NaN and ThresholdBoundsAvailable is false. If
+ * NumberOfBootstrapReplicates is not 0, all the intervals, including the
+ * threshold one, are percentile bootstrap intervals. When the exact
+ * computation is done, the bounds are the exact values.
  */
 
 template<class TInputImage, class TMaskImage=Image<unsigned char, TInputImage::ImageDimension>, class TOutputImage=Image<unsigned char, 2> >
@@ -90,6 +119,10 @@ public:
   typedef typename HistogramType::MeasurementVectorType MeasurementVectorType;
   typedef typename HistogramType::SizeType HistogramSizeType;
 
+  typedef typename HistogramGeneratorType::ListGeneratorType::ListSampleType SampleListType;
+  typedef typename HistogramGeneratorType::GeneratorType2 SampleHistogramGeneratorType;
+  typedef std::vector< VectorType > SampleVectorType;
+
   itkSetMacro(MaskValue, MaskPixelType);
   itkGetMacro(MaskValue, MaskPixelType);
 
@@ -146,6 +179,65 @@ public:
   itkGetConstMacro(Contribution1, MeasurementType);
   itkGetConstMacro(Contribution2, MeasurementType);
 
+  /** Set/Get the preview mode. Default is PreviewOff. */
+  itkSetMacro(Preview, bool);
+  itkGetConstMacro(Preview, bool);
+  itkBooleanMacro(Preview);
+
+  /** Set/Get the fraction of the voxels sampled in preview mode. It is a
+   * fraction of all the voxels of the image, even when a mask is used. It is
+   * not used if NumberOfSamples is not 0. Default is 0.01. */
+  itkSetClampMacro(SampleFraction, double, 0.0, 1.0);
+  itkGetConstMacro(SampleFraction, double);
+
+  /** Set/Get the number of voxels sampled in preview mode. 0 means that the
+   * number of samples is computed from SampleFraction. Default is 0. */
+  itkSetMacro(NumberOfSamples, unsigned long);
+  itkGetConstMacro(NumberOfSamples, unsigned long);
+
+  /** Set/Get the number of bootstrap replicates used to compute the
+   * confidence intervals in preview mode. 0 means that the analytic
+   * intervals are used. Default is 0.
+   * Each replicate resamples the voxels, builds a new histogram, and runs the
+   * threshold search on it, which costs O(NumberOfBins[0]^2 * NumberOfBins[1])
+   * histogram reads - about 2 millions with the default 128x128 bins. The
+   * cost of the bootstrap is thus NumberOfBootstrapReplicates times that,
+   * whatever the number of samples: use a small number of bins, or set
+   * ComputeThreshold to false, to keep it fast. */
+  itkSetMacro(NumberOfBootstrapReplicates, unsigned int);
+  itkGetConstMacro(NumberOfBootstrapReplicates, unsigned int);
+
+  /** Set/Get the confidence level of the intervals. Default is 0.95. */
+  itkSetClampMacro(ConfidenceLevel, double, 0.0, 1.0);
+  itkGetConstMacro(ConfidenceLevel, double);
+
+  /** Set/Get the seed of the random generator used in preview mode. */
+  itkSetMacro(Seed, unsigned long);
+  itkGetConstMacro(Seed, unsigned long);
+
+  /** Set/Get the maximum number of voxels drawn in preview mode with a mask,
+   * relative to the number of samples. Default is 10. */
+  itkSetMacro(MaximumNumberOfDrawsPerSample, unsigned int);
+  itkGetConstMacro(MaximumNumberOfDrawsPerSample, unsigned int);
+
+  /** Get the number of voxels actually used in preview mode. It can be lower
+   * than the number of samples when a mask is used. */
+  itkGetConstMacro(NumberOfSampledVoxels, unsigned long);
+
+  /** Get the bounds of the confidence intervals computed in preview mode. */
+  itkGetConstMacro(PearsonLowerBound, MeasurementType);
+  itkGetConstMacro(PearsonUpperBound, MeasurementType);
+  itkGetConstMacro(Contribution1LowerBound, MeasurementType);
+  itkGetConstMacro(Contribution1UpperBound, MeasurementType);
+  itkGetConstMacro(Contribution2LowerBound, MeasurementType);
+  itkGetConstMacro(Contribution2UpperBound, MeasurementType);
+  itkGetConstMacro(ThresholdLowerBound, MeasurementVectorType);
+  itkGetConstMacro(ThresholdUpperBound, MeasurementVectorType);
+
+  /** Get whether the bounds of the threshold have been computed. They are
+   * not with the analytic intervals. */
+  itkGetConstMacro(ThresholdBoundsAvailable, bool);
+
 protected:
   ColocalizationImageFilter();
   ~ColocalizationImageFilter(){};
@@ -155,6 +247,25 @@ protected:
   void GenerateData ();
   virtual void GenerateOutputInformation();
 
+  /** Draw the voxels used in preview mode. Return false if there is no
+   * voxel to draw. */
+  bool SampleVoxels( SampleVectorType & samples );
+
+  /** Compute the range of the histogram, used in both modes */
+  void ComputeHistogramRange();
+
+  /** Build the joint histogram of a set of samples */
+  typename HistogramType::ConstPointer ComputeSampleHistogram( const SampleVectorType & samples );
+
+  /** Run the calculator on a histogram, with the given threshold */
+  typename CalculatorType::Pointer ComputeCoefficients( const HistogramType * histogram,
+                                                        const MeasurementVectorType & threshold );
+
+  /** Compute the confidence intervals of the preview mode */
+  void ComputeAnalyticConfidenceIntervals( const HistogramType * histogram );
+  void ComputeBootstrapConfidenceIntervals( const SampleVectorType & samples,
+                                            const MeasurementVectorType & threshold );
+
 private:
   ColocalizationImageFilter(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -180,6 +291,28 @@ private:
   MeasurementType m_Contribution1;
   MeasurementType m_Contribution2;
 
+  bool m_Preview;
+  double m_SampleFraction;
+  unsigned long m_NumberOfSamples;
+  unsigned int m_NumberOfBootstrapReplicates;
+  double m_ConfidenceLevel;
+  unsigned long m_Seed;
+  unsigned int m_MaximumNumberOfDrawsPerSample;
+  unsigned long m_NumberOfSampledVoxels;
+
+  MeasurementType m_PearsonLowerBound;
+  MeasurementType m_PearsonUpperBound;
+  MeasurementType m_Contribution1LowerBound;
+  MeasurementType m_Contribution1UpperBound;
+  MeasurementType m_Contribution2LowerBound;
+  MeasurementType m_Contribution2UpperBound;
+  MeasurementVectorType m_ThresholdLowerBound;
+  MeasurementVectorType m_ThresholdUpperBound;
+  bool m_ThresholdBoundsAvailable;
+
+  MeasurementVectorType m_HistogramMin;
+  MeasurementVectorType m_HistogramMax;
+
 } ; // end of class
 
 } // end namespace itk
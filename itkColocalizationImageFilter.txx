@@ -20,6 +20,9 @@
 #include "itkColocalizationImageFilter.h"
 #include "itkBinaryThresholdImageFilter.h"
 #include "itkProgressAccumulator.h"
+#include "itkMinimumMaximumImageCalculator.h"
+#include "vnl/vnl_random.h"
+#include <algorithm>
 
 namespace itk {
 
@@ -45,6 +48,25 @@ ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
   m_NumberOfBins.Fill( 128 );
   m_Threshold.Fill( NumericTraits< MeasurementType >::Zero );
   m_ComputeThreshold = true;
+  m_Preview = false;
+  m_SampleFraction = 0.01;
+  m_NumberOfSamples = 0;
+  m_NumberOfBootstrapReplicates = 0;
+  m_ConfidenceLevel = 0.95;
+  m_Seed = 9667566;
+  m_MaximumNumberOfDrawsPerSample = 10;
+  m_NumberOfSampledVoxels = 0;
+  m_PearsonLowerBound = 0;
+  m_PearsonUpperBound = 0;
+  m_Contribution1LowerBound = 0;
+  m_Contribution1UpperBound = 0;
+  m_Contribution2LowerBound = 0;
+  m_Contribution2UpperBound = 0;
+  m_ThresholdLowerBound.Fill( NumericTraits< MeasurementType >::Zero );
+  m_ThresholdUpperBound.Fill( NumericTraits< MeasurementType >::Zero );
+  m_ThresholdBoundsAvailable = false;
+  m_HistogramMin.Fill( NumericTraits< MeasurementType >::Zero );
+  m_HistogramMax.Fill( NumericTraits< MeasurementType >::Zero );
   this->SetNumberOfRequiredInputs( 2 );
 }
 
@@ -56,28 +78,51 @@ ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
   typename ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
   progress->SetMiniPipelineFilter(this);
 
-  // create the image with the 2 channels
-  typename ComposeType::Pointer compose = ComposeType::New();
-  compose->SetInput1( this->GetInput( 0 ) );
-  compose->SetInput2( this->GetInput( 1 ) );
-  progress->RegisterInternalFilter( compose, .4f );
-  compose->Update();
-
-  // Create a histogram of the image intensities
-  typename HistogramGeneratorType::Pointer histogramGenerator = HistogramGeneratorType::New();
-  histogramGenerator->SetInput(  compose->GetOutput()  );
-  histogramGenerator->SetMaskImage( this->GetMaskImage()  );
-  histogramGenerator->SetMaskValue( m_MaskValue );
-  histogramGenerator->SetNumberOfBins( m_NumberOfBins );
-  // progress->RegisterInternalFilter(histogramGenerator,.5f);
-  histogramGenerator->Compute();
+  typename HistogramType::ConstPointer histogram;
+  SampleVectorType samples;
+  // the threshold given by the user, also used by the bootstrap replicates
+  MeasurementVectorType threshold = m_Threshold;
+
+  this->ComputeHistogramRange();
+
+  // only use a subsample of the voxels in preview mode, if there is
+  // something to sample
+  bool sampled = false;
+  m_NumberOfSampledVoxels = 0;
+  if( m_Preview )
+    {
+    sampled = this->SampleVoxels( samples );
+    if( sampled )
+      {
+      histogram = this->ComputeSampleHistogram( samples );
+      }
+    }
+
+  if( !sampled )
+    {
+    // create the image with the 2 channels
+    typename ComposeType::Pointer compose = ComposeType::New();
+    compose->SetInput1( this->GetInput( 0 ) );
+    compose->SetInput2( this->GetInput( 1 ) );
+    progress->RegisterInternalFilter( compose, .4f );
+    compose->Update();
+
+    // Create a histogram of the image intensities
+    typename HistogramGeneratorType::Pointer histogramGenerator = HistogramGeneratorType::New();
+    histogramGenerator->SetInput(  compose->GetOutput()  );
+    histogramGenerator->SetMaskImage( this->GetMaskImage()  );
+    histogramGenerator->SetMaskValue( m_MaskValue );
+    histogramGenerator->SetNumberOfBins( m_NumberOfBins );
+    histogramGenerator->SetAutoMinMax( false );
+    histogramGenerator->SetHistogramMin( m_HistogramMin );
+    histogramGenerator->SetHistogramMax( m_HistogramMax );
+    // progress->RegisterInternalFilter(histogramGenerator,.5f);
+    histogramGenerator->Compute();
+    histogram = histogramGenerator->GetOutput();
+    }
 
   // Compute the colocalization values for the input image
-  typename CalculatorType::Pointer calculator = CalculatorType::New();
-  calculator->SetInputHistogram( histogramGenerator->GetOutput() );
-  calculator->SetComputeThreshold( m_ComputeThreshold );
-  calculator->SetThreshold( m_Threshold );
-  calculator->Update();
+  typename CalculatorType::Pointer calculator = this->ComputeCoefficients( histogram, threshold );
   m_Threshold = calculator->GetThreshold();
   m_Pearson = calculator->GetPearson();
   m_Slope = calculator->GetSlope();
@@ -94,8 +139,33 @@ ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
   m_Contribution1 = calculator->GetContribution1();
   m_Contribution2 = calculator->GetContribution2();
 
+  if( sampled )
+    {
+    if( m_NumberOfBootstrapReplicates > 0 )
+      {
+      this->ComputeBootstrapConfidenceIntervals( samples, threshold );
+      }
+    else
+      {
+      this->ComputeAnalyticConfidenceIntervals( histogram );
+      }
+    }
+  else if( m_Preview )
+    {
+    // the exact values have been computed
+    m_PearsonLowerBound = m_Pearson;
+    m_PearsonUpperBound = m_Pearson;
+    m_Contribution1LowerBound = m_Contribution1;
+    m_Contribution1UpperBound = m_Contribution1;
+    m_Contribution2LowerBound = m_Contribution2;
+    m_Contribution2UpperBound = m_Contribution2;
+    m_ThresholdLowerBound = m_Threshold;
+    m_ThresholdUpperBound = m_Threshold;
+    m_ThresholdBoundsAvailable = true;
+    }
+
   typename LogType::Pointer log = LogType::New();
-  log->SetInput( histogramGenerator->GetOutput() );
+  log->SetInput( histogram );
   log->Update(); // fixed in itk 3.2, but required before that
   progress->RegisterInternalFilter( log, .3f );
   
@@ -109,6 +179,332 @@ ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
 }
 
 
+template<class TInputImage, class TMaskImage, class TOutputImage>
+typename ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>::CalculatorType::Pointer
+ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
+::ComputeCoefficients( const HistogramType * histogram, const MeasurementVectorType & threshold )
+{
+  typename CalculatorType::Pointer calculator = CalculatorType::New();
+  calculator->SetInputHistogram( histogram );
+  calculator->SetComputeThreshold( m_ComputeThreshold );
+  calculator->SetThreshold( threshold );
+  calculator->Update();
+  return calculator;
+}
+
+
+template<class TInputImage, class TMaskImage, class TOutputImage>
+void
+ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
+::ComputeHistogramRange()
+{
+  typedef MinimumMaximumImageCalculator< InputImageType > MinimumMaximumCalculatorType;
+  for( unsigned int i=0; i<2; i++ )
+    {
+    MeasurementType minimum;
+    MeasurementType maximum;
+    MeasurementType margin;
+    if( NumericTraits< InputPixelType >::is_integer )
+      {
+      // the maximum is put in the last bin by extending the range by one
+      // value
+      minimum = static_cast< MeasurementType >( NumericTraits< InputPixelType >::NonpositiveMin() );
+      maximum = static_cast< MeasurementType >( NumericTraits< InputPixelType >::max() );
+      margin = 1;
+      }
+    else
+      {
+      // the range of the pixel type is too large to be usable
+      typename MinimumMaximumCalculatorType::Pointer calculator = MinimumMaximumCalculatorType::New();
+      calculator->SetImage( this->GetInput( i ) );
+      calculator->Compute();
+      minimum = static_cast< MeasurementType >( calculator->GetMinimum() );
+      maximum = static_cast< MeasurementType >( calculator->GetMaximum() );
+      margin = ( maximum - minimum ) / m_NumberOfBins[i] / 100.0;
+      if( margin <= 0 )
+        {
+        margin = 1;
+        }
+      }
+    m_HistogramMin[i] = minimum;
+    m_HistogramMax[i] = maximum + margin;
+    }
+}
+
+
+template<class TInputImage, class TMaskImage, class TOutputImage>
+bool
+ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
+::SampleVoxels( SampleVectorType & samples )
+{
+  const InputImageType * input0 = this->GetInput( 0 );
+  const InputImageType * input1 = this->GetInput( 1 );
+  const MaskImageType * mask = this->GetMaskImage();
+
+  const InputImageRegionType & region = input0->GetRequestedRegion();
+  const InputSizeType & size = region.GetSize();
+  const unsigned long numberOfPixels = region.GetNumberOfPixels();
+
+  samples.clear();
+  if( numberOfPixels == 0 )
+    {
+    return false;
+    }
+
+  unsigned long numberOfSamples = m_NumberOfSamples;
+  if( numberOfSamples == 0 )
+    {
+    numberOfSamples = static_cast< unsigned long >( vcl_ceil( m_SampleFraction * numberOfPixels ) );
+    }
+  numberOfSamples = std::max( 1UL, std::min( numberOfSamples, numberOfPixels ) );
+
+  // without a mask, all the voxels drawn are used. With a mask, the voxels
+  // out of the mask are rejected, and new voxels are drawn until the number
+  // of samples is reached, or too many voxels have been drawn.
+  double maximumNumberOfDraws = numberOfSamples;
+  if( mask )
+    {
+    maximumNumberOfDraws *= std::max( 1U, m_MaximumNumberOfDrawsPerSample );
+    }
+
+  vnl_random random( m_Seed );
+  samples.reserve( numberOfSamples );
+  SampleVectorType accepted;
+  VectorType v;
+  double numberOfDraws = 0;
+  double numberOfAccepted = 0;
+  while( samples.size() < numberOfSamples && numberOfDraws < maximumNumberOfDraws )
+    {
+    // draw enough voxels to reach the number of samples at the acceptance
+    // rate observed so far
+    const unsigned long remaining = numberOfSamples - samples.size();
+    double numberOfBlocks = remaining;
+    if( numberOfAccepted > 0 )
+      {
+      numberOfBlocks = vcl_ceil( remaining * numberOfDraws / numberOfAccepted );
+      }
+    else if( numberOfDraws > 0 )
+      {
+      numberOfBlocks = maximumNumberOfDraws - numberOfDraws;
+      }
+    numberOfBlocks = std::min( numberOfBlocks, maximumNumberOfDraws - numberOfDraws );
+    numberOfBlocks = std::min( numberOfBlocks, static_cast< double >( numberOfPixels ) );
+    const unsigned long blocks = static_cast< unsigned long >( numberOfBlocks );
+
+    // draw one voxel in each block of consecutive voxels of the region
+    const double blockSize = numberOfPixels / numberOfBlocks;
+    accepted.clear();
+    for( unsigned long k=0; k<blocks; k++ )
+      {
+      unsigned long offset = static_cast< unsigned long >( ( k + random.drand64( 0, 1 ) ) * blockSize );
+      offset = std::min( offset, numberOfPixels - 1 );
+      InputIndexType idx = region.GetIndex();
+      for( unsigned int d=0; d<InputImageDimension; d++ )
+        {
+        idx[d] += offset % size[d];
+        offset /= size[d];
+        }
+      if( mask && mask->GetPixel( idx ) != m_MaskValue )
+        {
+        continue;
+        }
+      v[0] = input0->GetPixel( idx );
+      v[1] = input1->GetPixel( idx );
+      accepted.push_back( v );
+      }
+    numberOfDraws += blocks;
+    numberOfAccepted += accepted.size();
+
+    // too many voxels accepted: keep a random subset, so no part of the
+    // region is favored
+    if( accepted.size() > remaining )
+      {
+      for( unsigned long i=0; i<remaining; i++ )
+        {
+        unsigned long j = i + static_cast< unsigned long >( random.drand64( 0, 1 ) * ( accepted.size() - i ) );
+        std::swap( accepted[i], accepted[ std::min( j, (unsigned long)accepted.size() - 1 ) ] );
+        }
+      accepted.resize( remaining );
+      }
+    samples.insert( samples.end(), accepted.begin(), accepted.end() );
+    }
+
+  m_NumberOfSampledVoxels = samples.size();
+  return !samples.empty();
+}
+
+
+template<class TInputImage, class TMaskImage, class TOutputImage>
+typename ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>::HistogramType::ConstPointer
+ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
+::ComputeSampleHistogram( const SampleVectorType & samples )
+{
+  typename SampleListType::Pointer list = SampleListType::New();
+  list->SetMeasurementVectorSize( 2 );
+  list->Resize( samples.size() );
+  for( unsigned long i=0; i<samples.size(); i++ )
+    {
+    list->SetMeasurementVector( i, samples[i] );
+    }
+
+  typename SampleHistogramGeneratorType::Pointer generator = SampleHistogramGeneratorType::New();
+  generator->SetListSample( list );
+  generator->SetNumberOfBins( m_NumberOfBins );
+  generator->SetAutoMinMax( false );
+  generator->SetHistogramMin( m_HistogramMin );
+  generator->SetHistogramMax( m_HistogramMax );
+  generator->Update();
+  return generator->GetOutput();
+}
+
+
+template<class TInputImage, class TMaskImage, class TOutputImage>
+void
+ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
+::ComputeAnalyticConfidenceIntervals( const HistogramType * histogram )
+{
+  // normal quantile for the confidence level (Abramowitz and Stegun 26.2.23)
+  double p = ( 1.0 - m_ConfidenceLevel ) / 2.0;
+  double z = 0;
+  if( p > 0 )
+    {
+    double t = vcl_sqrt( -2.0 * vcl_log( p ) );
+    z = t - ( 2.515517 + 0.802853 * t + 0.010328 * t * t )
+      / ( 1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t );
+    }
+
+  double n = histogram->GetTotalFrequency();
+
+  // Fisher's z transform for Pearson
+  m_PearsonLowerBound = -1;
+  m_PearsonUpperBound = 1;
+  if( n > 3 && vcl_fabs( m_Pearson ) < 1 )
+    {
+    double fz = 0.5 * vcl_log( ( 1.0 + m_Pearson ) / ( 1.0 - m_Pearson ) );
+    double se = 1.0 / vcl_sqrt( n - 3.0 );
+    m_PearsonLowerBound = vcl_tanh( fz - z * se );
+    m_PearsonUpperBound = vcl_tanh( fz + z * se );
+    }
+
+  // delta method for the Manders coefficients, which are ratios of sums.
+  // The bins are used like in the calculator, so the standard error is the
+  // one of the computed coefficients.
+  double sum0 = 0;
+  double sum1 = 0;
+  double var1 = 0;
+  double var2 = 0;
+  for (unsigned int i = 0; i < histogram->GetSize( 0 ); i++)
+    {
+    const MeasurementType & s0 = histogram->GetMeasurement( i, 0 );
+
+    for (unsigned int j = 0; j < histogram->GetSize( 1 ); j++)
+      {
+      const MeasurementType & s1 = histogram->GetMeasurement( j, 1 );
+
+      typename HistogramType::IndexType index;
+      index[0] = i;
+      index[1] = j;
+      const double freq = histogram->GetFrequency( index );
+      if( freq == 0 )
+        {
+        continue;
+        }
+
+      double s0coloc = s1 > m_Threshold[1] ? s0 : 0;
+      double s1coloc = s0 > m_Threshold[0] ? s1 : 0;
+      sum0 += freq * s0;
+      sum1 += freq * s1;
+      var1 += freq * vcl_pow( s0coloc - m_Contribution1 * s0, 2 );
+      var2 += freq * vcl_pow( s1coloc - m_Contribution2 * s1, 2 );
+      }
+    }
+
+  m_Contribution1LowerBound = 0;
+  m_Contribution1UpperBound = 1;
+  m_Contribution2LowerBound = 0;
+  m_Contribution2UpperBound = 1;
+  if( n > 1 && sum0 > 0 )
+    {
+    // var( R ) = sum( ( x - R y )^2 ) / ( n - 1 ) / ( n * mean( y )^2 )
+    double se = vcl_sqrt( var1 * n / ( n - 1 ) ) / sum0;
+    m_Contribution1LowerBound = std::max( 0.0, m_Contribution1 - z * se );
+    m_Contribution1UpperBound = std::min( 1.0, m_Contribution1 + z * se );
+    }
+  if( n > 1 && sum1 > 0 )
+    {
+    double se = vcl_sqrt( var2 * n / ( n - 1 ) ) / sum1;
+    m_Contribution2LowerBound = std::max( 0.0, m_Contribution2 - z * se );
+    m_Contribution2UpperBound = std::min( 1.0, m_Contribution2 + z * se );
+    }
+
+  // no analytic interval for the threshold
+  m_ThresholdLowerBound.Fill( NumericTraits< MeasurementType >::quiet_NaN() );
+  m_ThresholdUpperBound.Fill( NumericTraits< MeasurementType >::quiet_NaN() );
+  m_ThresholdBoundsAvailable = false;
+}
+
+
+template<class TInputImage, class TMaskImage, class TOutputImage>
+void
+ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
+::ComputeBootstrapConfidenceIntervals( const SampleVectorType & samples,
+                                       const MeasurementVectorType & threshold )
+{
+  unsigned int numberOfReplicates = m_NumberOfBootstrapReplicates;
+  unsigned long n = samples.size();
+
+  std::vector< MeasurementType > pearson( numberOfReplicates );
+  std::vector< MeasurementType > contribution1( numberOfReplicates );
+  std::vector< MeasurementType > contribution2( numberOfReplicates );
+  std::vector< MeasurementType > threshold0( numberOfReplicates );
+  std::vector< MeasurementType > threshold1( numberOfReplicates );
+
+  // don't reuse the sequence used to draw the voxels
+  vnl_random random( m_Seed + 1 );
+  SampleVectorType replicate( n );
+
+  for( unsigned int r=0; r<numberOfReplicates; r++ )
+    {
+    // resample with replacement
+    for( unsigned long i=0; i<n; i++ )
+      {
+      unsigned long j = static_cast< unsigned long >( random.drand64( 0, 1 ) * n );
+      replicate[i] = samples[ std::min( j, n - 1 ) ];
+      }
+
+    typename HistogramType::ConstPointer histogram = this->ComputeSampleHistogram( replicate );
+    typename CalculatorType::Pointer calculator = this->ComputeCoefficients( histogram, threshold );
+    pearson[r] = calculator->GetPearson();
+    contribution1[r] = calculator->GetContribution1();
+    contribution2[r] = calculator->GetContribution2();
+    threshold0[r] = calculator->GetThreshold()[0];
+    threshold1[r] = calculator->GetThreshold()[1];
+    }
+
+  // percentile intervals
+  unsigned int lower = static_cast< unsigned int >( vcl_floor( ( 1.0 - m_ConfidenceLevel ) / 2.0 * ( numberOfReplicates - 1 ) ) );
+  unsigned int upper = static_cast< unsigned int >( vcl_ceil( ( 1.0 + m_ConfidenceLevel ) / 2.0 * ( numberOfReplicates - 1 ) ) );
+
+  std::sort( pearson.begin(), pearson.end() );
+  std::sort( contribution1.begin(), contribution1.end() );
+  std::sort( contribution2.begin(), contribution2.end() );
+  std::sort( threshold0.begin(), threshold0.end() );
+  std::sort( threshold1.begin(), threshold1.end() );
+
+  m_PearsonLowerBound = pearson[lower];
+  m_PearsonUpperBound = pearson[upper];
+  m_Contribution1LowerBound = contribution1[lower];
+  m_Contribution1UpperBound = contribution1[upper];
+  m_Contribution2LowerBound = contribution2[lower];
+  m_Contribution2UpperBound = contribution2[upper];
+  m_ThresholdLowerBound[0] = threshold0[lower];
+  m_ThresholdLowerBound[1] = threshold1[lower];
+  m_ThresholdUpperBound[0] = threshold0[upper];
+  m_ThresholdUpperBound[1] = threshold1[upper];
+  m_ThresholdBoundsAvailable = true;
+}
+
+
 template<class TInputImage, class TMaskImage, class TOutputImage>
 void
 ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
@@ -163,6 +559,23 @@ ColocalizationImageFilter<TInputImage, TMaskImage, TOutputImage>
   os << indent << "ColocalizedOverlap2: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_ColocalizedOverlap2) << std::endl;
   os << indent << "Contribution1: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_Contribution1) << std::endl;
   os << indent << "Contribution2: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_Contribution2) << std::endl;
+  os << indent << "Preview: " << m_Preview << std::endl;
+  os << indent << "SampleFraction: " << m_SampleFraction << std::endl;
+  os << indent << "NumberOfSamples: " << m_NumberOfSamples << std::endl;
+  os << indent << "NumberOfBootstrapReplicates: " << m_NumberOfBootstrapReplicates << std::endl;
+  os << indent << "ConfidenceLevel: " << m_ConfidenceLevel << std::endl;
+  os << indent << "Seed: " << m_Seed << std::endl;
+  os << indent << "MaximumNumberOfDrawsPerSample: " << m_MaximumNumberOfDrawsPerSample << std::endl;
+  os << indent << "NumberOfSampledVoxels: " << m_NumberOfSampledVoxels << std::endl;
+  os << indent << "PearsonLowerBound: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_PearsonLowerBound) << std::endl;
+  os << indent << "PearsonUpperBound: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_PearsonUpperBound) << std::endl;
+  os << indent << "Contribution1LowerBound: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_Contribution1LowerBound) << std::endl;
+  os << indent << "Contribution1UpperBound: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_Contribution1UpperBound) << std::endl;
+  os << indent << "Contribution2LowerBound: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_Contribution2LowerBound) << std::endl;
+  os << indent << "Contribution2UpperBound: " << static_cast<typename NumericTraits<MeasurementType>::PrintType>(m_Contribution2UpperBound) << std::endl;
+  os << indent << "ThresholdLowerBound: " << m_ThresholdLowerBound << std::endl;
+  os << indent << "ThresholdUpperBound: " << m_ThresholdUpperBound << std::endl;
+  os << indent << "ThresholdBoundsAvailable: " << m_ThresholdBoundsAvailable << std::endl;
 }
 
 }// end namespace itk
@@ -23,6 +23,7 @@
 #include "itkDataObject.h"
 #include "itkDataObjectDecorator.h"
 #include "itkFixedArray.h"
+#include "itkMultiThreader.h"
 
 namespace itk{ 
 namespace Statistics{
@@ -40,6 +41,14 @@ namespace Statistics{
  *  list sample (if a mask is specified) is constructed from pixels that are
  *  within the mask
  *
+ *  The list sample is filled in two passes: the number of pixels in the mask
+ *  is first counted, so the list sample can be allocated once with its final
+ *  size, and the pixels are then copied in it. Both passes are multithreaded:
+ *  the buffered region is split along its outermost dimension, and each 
+ *  thread writes its pixels at the offset given by the counts of the
+ *  previous regions, so the order of the pixels in the list sample is the
+ *  same as the order of the pixels in the image.
+ *
  * \todo 
  * In future allow the filter to take a Spatial object as input so a 
  * generic spatial object like an ellipse etc can be used as a mask. 
@@ -72,6 +81,7 @@ public:
   typedef typename ImageType::Pointer      ImagePointer ;
   typedef typename ImageType::ConstPointer ImageConstPointer ;
   typedef typename ImageType::PixelType    PixelType ;
+  typedef typename ImageType::RegionType   RegionType ;
   typedef PixelType       MeasurementVectorType;
 
   /** Mask Image typedefs */
@@ -88,6 +98,7 @@ public:
   typedef PixelTraits< typename ImageType::PixelType > PixelTraitsType;
   typedef typename ListSampleType::MeasurementVectorSizeType 
                                      MeasurementVectorSizeType;
+  typedef typename ListSampleType::InstanceIdentifier InstanceIdentifier;
   
   typedef DataObject::Pointer DataObjectPointer;
 
@@ -154,12 +165,39 @@ protected:
   virtual ~ImageToListGenerator() {}
   void PrintSelf(std::ostream& os, Indent indent) const;  
 
+  /** Split the buffered region of the input image into at most num pieces
+   * along its outermost dimension, and return the ith one in splitRegion.
+   * Return the number of pieces actually used. */
+  virtual int SplitRegion(int i, int num, RegionType& splitRegion);
+
+  /** Count the pixels of the region which are in the mask. Only used when a
+   * mask is specified. */
+  virtual void ThreadedCount(const RegionType& region, int threadId);
+
+  /** Copy the pixels of the region in the list sample, starting at the 
+   * offset computed for this thread. */
+  virtual void ThreadedGenerateData(const RegionType& region, int threadId);
+
+  /** Static function used as a "callback" by the MultiThreader. */
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Internal structure used for passing data to the threading library */
+  struct ThreadStruct
+  {
+   Pointer Filter;
+   bool Count;
+  };
+
 private:
   ImageToListGenerator(const Self&) ; //purposely not implemented
   void operator=(const Self&) ; //purposely not implemented
 
   MaskPixelType m_MaskValue;
 
+  /** Number of pixels found by each thread, then offset of each thread in
+   * the list sample once accumulated */
+  std::vector< InstanceIdentifier > m_ThreadOffsets;
+
 }; // end of class ImageToListGenerator
 
 } // end of namespace Statistics
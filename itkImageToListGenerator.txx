@@ -108,30 +108,104 @@ ImageToListGenerator< TImage, TMaskImage >
   ListSampleOutputType * decoratedOutput = static_cast< ListSampleOutputType * >(
                                  this->ProcessObject::GetOutput(0));
   ListSampleType *output = decoratedOutput->Get();
-  ImageType *input = const_cast< ImageType * >(this->GetInput());
-  MaskImageType *maskImage = NULL;
   
   output->Clear();
 
-  if (this->GetNumberOfInputs() > 1)
+  // nothing to do with an empty image, and the region can't be split
+  if (this->GetInput()->GetBufferedRegion().GetNumberOfPixels() == 0)
     {
-    maskImage = const_cast< MaskImageType * >(this->GetMaskImage());
+    return;
     }
 
+  // use the number of threads actually available in the multithreader, so
+  // the regions are split the same way in the count and in the copy passes
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  int numberOfThreads = this->GetMultiThreader()->GetNumberOfThreads();
+  m_ThreadOffsets.assign( numberOfThreads, 0 );
+
+  ThreadStruct str;
+  str.Filter = this;
+
+  // count the pixels to be added by each thread
+  if (this->GetMaskImage()) // mask specified
+    {
+    str.Count = true;
+    this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+    this->GetMultiThreader()->SingleMethodExecute();
+    }
+  else // no mask specified
+    {
+    RegionType splitRegion;
+    int total = this->SplitRegion( 0, numberOfThreads, splitRegion );
+    for( int i=0; i<total; i++ )
+      {
+      this->SplitRegion( i, numberOfThreads, splitRegion );
+      m_ThreadOffsets[i] = splitRegion.GetNumberOfPixels();
+      }
+    }
+
+  // turn the counts in offsets, and allocate the list sample once
+  InstanceIdentifier size = 0;
+  for( int i=0; i<numberOfThreads; i++ )
+    {
+    InstanceIdentifier count = m_ThreadOffsets[i];
+    m_ThreadOffsets[i] = size;
+    size += count;
+    }
+  output->Resize( size );
+
+  // and copy the pixels
+  str.Count = false;
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+  this->GetMultiThreader()->SingleMethodExecute();
+}
+
+template < class TImage, class TMaskImage >
+void
+ImageToListGenerator< TImage, TMaskImage >
+::ThreadedCount(const RegionType& region, int threadId)
+{
+  // only used when a mask is specified: without mask, the counts are the
+  // sizes of the regions and are computed in GenerateData()
+  const MaskImageType *maskImage = this->GetMaskImage();
+
+  InstanceIdentifier count = 0;
+  typedef ImageRegionConstIterator< MaskImageType > MaskIteratorType;
+  MaskIteratorType mit( maskImage, region );
+  for( mit.GoToBegin(); !mit.IsAtEnd(); ++mit )
+    {
+    if (mit.Get() == this->m_MaskValue)
+      {
+      count++;
+      }
+    }
+  m_ThreadOffsets[threadId] = count;
+}
+
+template < class TImage, class TMaskImage >
+void
+ImageToListGenerator< TImage, TMaskImage >
+::ThreadedGenerateData(const RegionType& region, int threadId)
+{
+  ListSampleType *output = this->GetListSample();
+  const ImageType *input = this->GetInput();
+  const MaskImageType *maskImage = this->GetMaskImage();
+  InstanceIdentifier id = m_ThreadOffsets[threadId];
+
   typedef ImageRegionConstIterator< ImageType >     IteratorType; 
-  IteratorType it( input, input->GetBufferedRegion() );
+  IteratorType it( input, region );
   it.GoToBegin();
   
   if (maskImage) // mask specified
     {
     typedef ImageRegionConstIterator< MaskImageType > MaskIteratorType;
-    MaskIteratorType mit( maskImage, maskImage->GetBufferedRegion() );
+    MaskIteratorType mit( maskImage, region );
     mit.GoToBegin();
     while (!it.IsAtEnd())
       {
       if (mit.Get() == this->m_MaskValue)
         {
-        output->PushBack( it.Get() );
+        output->SetMeasurementVector( id++, it.Get() );
         }
       ++mit;
       ++it;
@@ -141,9 +215,93 @@ ImageToListGenerator< TImage, TMaskImage >
     {
     while (!it.IsAtEnd())
       {
-      output->PushBack( it.Get() );
+      output->SetMeasurementVector( id++, it.Get() );
+      ++it;
+      }
+    }
+}
+
+template < class TImage, class TMaskImage >
+int
+ImageToListGenerator< TImage, TMaskImage >
+::SplitRegion(int i, int num, RegionType& splitRegion)
+{
+  const RegionType & region = this->GetInput()->GetBufferedRegion();
+  const typename RegionType::SizeType & regionSize = region.GetSize();
+  typename RegionType::IndexType splitIndex = region.GetIndex();
+  typename RegionType::SizeType splitSize = regionSize;
+  splitRegion = region;
+
+  // split on the outermost dimension available
+  int splitAxis = ImageType::ImageDimension - 1;
+  while (regionSize[splitAxis] == 1)
+    {
+    --splitAxis;
+    if (splitAxis < 0)
+      { // cannot split
+      return 1;
+      }
+    }
+
+  // determine the actual number of pieces that will be generated
+  typename RegionType::SizeType::SizeValueType range = regionSize[splitAxis];
+  int valuesPerThread = (int)vcl_ceil(range/(double)num);
+  int maxThreadIdUsed = (int)vcl_ceil(range/(double)valuesPerThread) - 1;
+
+  // split the region
+  if (i < maxThreadIdUsed)
+    {
+    splitIndex[splitAxis] += i*valuesPerThread;
+    splitSize[splitAxis] = valuesPerThread;
+    }
+  if (i == maxThreadIdUsed)
+    {
+    splitIndex[splitAxis] += i*valuesPerThread;
+    // last thread needs to process the "rest" dimension being split
+    splitSize[splitAxis] = splitSize[splitAxis] - i*valuesPerThread;
+    }
+
+  splitRegion.SetIndex( splitIndex );
+  splitRegion.SetSize( splitSize );
+
+  return maxThreadIdUsed + 1;
+}
+
+template < class TImage, class TMaskImage >
+ITK_THREAD_RETURN_TYPE
+ImageToListGenerator< TImage, TMaskImage >
+::ThreaderCallback( void *arg )
+{
+  ThreadStruct *str;
+  int total, threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  // execute the actual method with appropriate region
+  RegionType splitRegion;
+  total = str->Filter->SplitRegion(threadId, threadCount, splitRegion);
+
+  if (threadId < total)
+    {
+    if (str->Count)
+      {
+      str->Filter->ThreadedCount(splitRegion, threadId);
+      }
+    else
+      {
+      str->Filter->ThreadedGenerateData(splitRegion, threadId);
       }
     }
+  // else
+  //   {
+  //   otherwise don't use this thread. Sometimes the threads dont
+  //   break up very well and it is just as efficient to leave a 
+  //   few threads idle.
+  //   }
+
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 template < class TImage, class TMaskImage >
@@ -0,0 +1,253 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    $RCSfile: itkObjectColocalizationImageFilter.h,v $
+  Language:  C++
+  Date:      $Date: 2007/01/24 10:00:00 $
+  Version:   $Revision: 1.1 $
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef __itkObjectColocalizationImageFilter_h
+#define __itkObjectColocalizationImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkFixedArray.h"
+#include "itkNumericTraits.h"
+#include <vector>
+#include <map>
+
+namespace itk {
+
+/** \class ObjectColocalizationImageFilter
+ * \brief Computes object based colocalization coefficients
+ *
+ * The two channels are binarized with the thresholds given with
+ * SetThreshold() - typically the ones computed by ColocalizationImageFilter -
+ * and the connected components of both binary images are labeled in a single
+ * pass with a union-find structure. The overlap area of each pair of objects
+ * is accumulated during the same pass.
+ *
+ * The labeling is multithreaded: each thread labels its own strip of the
+ * image, and the labels are merged at the strip borders once all the threads
+ * are done. No label image is kept: each thread only stores the labels of
+ * the last two layers of voxels it has visited, and the labels of the first
+ * and last layers of its strip for the merge.
+ *
+ * The input image is passed through as the output, and the results are
+ * available with the Get methods:
+ *   - NumberOfObjects1 and NumberOfObjects2: the number of objects in each
+ *     channel;
+ *   - ObjectOverlap1 (ObjectOverlap2): the fraction of the objects of
+ *     channel 1 (2) which overlap at least one object of channel 2 (1);
+ *   - ObjectContribution1 (ObjectContribution2): the fraction of the area of
+ *     the objects of channel 1 (2) which is in objects overlapping at least
+ *     one object of channel 2 (1). This is the object level equivalent of the
+ *     Manders coefficients;
+ *   - ObjectSizes1 and ObjectSizes2: the area of each object, indexed by
+ *     label;
+ *   - OverlapAreas: the overlap area of each pair of overlapping objects.
+ *
+ * The labels are consecutive, start at 1, and are attributed in the raster
+ * order of the first pixel of the objects.
+ *
+ * \sa ColocalizationImageFilter
+ */
+
+template<class TInputImage, class TMaskImage=Image<unsigned char, TInputImage::ImageDimension> >
+class ITK_EXPORT ObjectColocalizationImageFilter :
+    public ImageToImageFilter<TInputImage, TInputImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef ObjectColocalizationImageFilter Self;
+  typedef ImageToImageFilter<TInputImage,TInputImage>  Superclass;
+  typedef SmartPointer<Self>        Pointer;
+  typedef SmartPointer<const Self>  ConstPointer;
+
+  /** Image related typedefs. */
+  itkStaticConstMacro(ImageDimension, unsigned int,
+                      TInputImage::ImageDimension ) ;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(ObjectColocalizationImageFilter, ImageToImageFilter);
+
+  /** Standard image type within this class. */
+  typedef TInputImage InputImageType;
+  typedef TMaskImage MaskImageType;
+
+  /** Image pixel value typedef. */
+  typedef typename TInputImage::PixelType   InputPixelType;
+  typedef typename TMaskImage::PixelType   MaskPixelType;
+
+  /** Image related typedefs. */
+  typedef typename TInputImage::Pointer InputImagePointer;
+  typedef typename TMaskImage::Pointer MaskImagePointer;
+
+  typedef typename TInputImage::SizeType  SizeType;
+  typedef typename TInputImage::IndexType  IndexType;
+  typedef typename TInputImage::OffsetType  OffsetType;
+  typedef typename TInputImage::RegionType RegionType;
+
+  /** The threshold type is the same as in ColocalizationImageFilter, so its
+   * computed threshold can be passed directly to this filter */
+  typedef typename NumericTraits< InputPixelType >::RealType MeasurementType;
+  typedef FixedArray< MeasurementType, 2 > MeasurementVectorType;
+
+  /** Label related typedefs. */
+  typedef unsigned long LabelType;
+  typedef std::vector< LabelType > LabelVectorType;
+  typedef std::vector< unsigned long > SizeVectorType;
+  typedef std::pair< LabelType, LabelType > LabelPairType;
+  typedef std::map< LabelPairType, unsigned long > OverlapMapType;
+
+  itkSetMacro(MaskValue, MaskPixelType);
+  itkGetMacro(MaskValue, MaskPixelType);
+
+   /** Set the mask image */
+  void SetMaskImage(MaskImageType *input)
+     {
+     // Process object is not const-correct so the const casting is required.
+     this->SetNthInput( 2, const_cast<MaskImageType *>(input) );
+     }
+
+  /** Get the mask image */
+  MaskImageType * GetMaskImage()
+    {
+    return static_cast<MaskImageType*>(const_cast<DataObject *>(this->ProcessObject::GetInput(2)));
+    }
+
+   /** Set the mask image */
+  void SetInput3(MaskImageType *input)
+     {
+     this->SetMaskImage( input );
+     }
+
+  /** Set/Get the thresholds used to binarize the two channels. A pixel is
+   * part of an object if its value is strictly greater than the threshold.
+   */
+  itkSetMacro(Threshold, MeasurementVectorType);
+  itkGetConstMacro(Threshold, MeasurementVectorType);
+
+  /** Set/Get whether the connected components are defined strictly by face
+   * connectivity or by face+edge+vertex connectivity. Default is
+   * FullyConnectedOff. */
+  itkSetMacro(FullyConnected, bool);
+  itkGetConstReferenceMacro(FullyConnected, bool);
+  itkBooleanMacro(FullyConnected);
+
+  itkGetConstMacro(NumberOfObjects1, unsigned long);
+  itkGetConstMacro(NumberOfObjects2, unsigned long);
+  itkGetConstMacro(NumberOfColocalizedObjects1, unsigned long);
+  itkGetConstMacro(NumberOfColocalizedObjects2, unsigned long);
+  itkGetConstMacro(ObjectOverlap1, double);
+  itkGetConstMacro(ObjectOverlap2, double);
+  itkGetConstMacro(ObjectContribution1, double);
+  itkGetConstMacro(ObjectContribution2, double);
+
+  itkGetConstReferenceMacro(ObjectSizes1, SizeVectorType);
+  itkGetConstReferenceMacro(ObjectSizes2, SizeVectorType);
+  itkGetConstReferenceMacro(OverlapAreas, OverlapMapType);
+
+protected:
+  ObjectColocalizationImageFilter();
+  ~ObjectColocalizationImageFilter(){};
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** Pass the input through unmodified. Do this by Grafting in the
+   * AllocateOutputs method. */
+  void AllocateOutputs();
+
+  void GenerateInputRequestedRegion();
+  void EnlargeOutputRequestedRegion(DataObject *output);
+
+  void BeforeThreadedGenerateData ();
+  void ThreadedGenerateData (const RegionType& outputRegionForThread,
+                             int threadId) ;
+  void AfterThreadedGenerateData ();
+
+private:
+  ObjectColocalizationImageFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  /** Data produced by a thread on its strip. The labels are local to the
+   * thread and start at 1. The arrays are indexed by channel.
+   * Buffer is a rolling buffer with the labels of the last two layers of
+   * voxels visited; FirstLayer and LastLayer store the labels of the first and
+   * last layers of the strip, used to merge the labels at the strip borders.
+   */
+  struct ThreadData
+    {
+    RegionType Region;
+    LabelVectorType Parent[2];
+    SizeVectorType Sizes[2];
+    LabelVectorType Buffer[2];
+    LabelVectorType FirstLayer[2];
+    LabelVectorType LastLayer[2];
+    OverlapMapType Overlaps;
+    };
+
+  /** Union-find helpers */
+  static LabelType FindRoot( LabelVectorType & parent, LabelType label );
+  static void Union( LabelVectorType & parent, LabelType label1, LabelType label2 );
+
+  /** Label the foreground pixel at index, and at position in the raster
+   * order of the strip, from the labels of its already visited neighbors in
+   * the same strip. The neighbors are not checked to be in the strip if the
+   * pixel is an interior one. */
+  LabelType LabelPixel( unsigned int channel, const IndexType & index,
+                        unsigned long position, bool interior, ThreadData & data );
+
+  /** Merge the labels of the objects crossing the strip borders, and compute
+   * the final label of each thread label and the size of each object. base
+   * receives the offset of the labels of each thread in finalLabels. Return
+   * the number of objects. */
+  unsigned long ComputeFinalLabels( unsigned int channel, LabelVectorType & base,
+                                    LabelVectorType & finalLabels, SizeVectorType & sizes );
+
+  MeasurementVectorType m_Threshold ;
+  bool m_FullyConnected;
+
+  MaskPixelType m_MaskValue;
+
+  unsigned long m_NumberOfObjects1;
+  unsigned long m_NumberOfObjects2;
+  unsigned long m_NumberOfColocalizedObjects1;
+  unsigned long m_NumberOfColocalizedObjects2;
+  double m_ObjectOverlap1;
+  double m_ObjectOverlap2;
+  double m_ObjectContribution1;
+  double m_ObjectContribution2;
+
+  SizeVectorType m_ObjectSizes1;
+  SizeVectorType m_ObjectSizes2;
+  OverlapMapType m_OverlapAreas;
+
+  /** Internal data. The image is split along m_SplitAxis, and a layer is
+   * the set of voxels with the same index on this axis. */
+  unsigned int m_SplitAxis;
+  unsigned long m_LayerSize;
+  std::vector< unsigned long > m_Strides;
+  std::vector< OffsetType > m_PreviousNeighbors;
+  std::vector< unsigned long > m_PreviousDistances;
+  std::vector< OffsetType > m_BorderNeighbors;
+  std::vector< ThreadData > m_ThreadData;
+
+} ; // end of class
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkObjectColocalizationImageFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,598 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    $RCSfile: itkObjectColocalizationImageFilter.txx,v $
+  Language:  C++
+  Date:      $Date: 2007/01/24 10:00:00 $
+  Version:   $Revision: 1.1 $
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _itkObjectColocalizationImageFilter_txx
+#define _itkObjectColocalizationImageFilter_txx
+
+#include "itkObjectColocalizationImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+#include "itkProgressReporter.h"
+
+namespace itk {
+
+template<class TInputImage, class TMaskImage>
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::ObjectColocalizationImageFilter()
+{
+  m_MaskValue = NumericTraits<MaskPixelType>::max();
+  m_Threshold.Fill( NumericTraits< MeasurementType >::Zero );
+  m_FullyConnected = false;
+  m_NumberOfObjects1 = 0;
+  m_NumberOfObjects2 = 0;
+  m_NumberOfColocalizedObjects1 = 0;
+  m_NumberOfColocalizedObjects2 = 0;
+  m_ObjectOverlap1 = 0;
+  m_ObjectOverlap2 = 0;
+  m_ObjectContribution1 = 0;
+  m_ObjectContribution2 = 0;
+  this->SetNumberOfRequiredInputs( 2 );
+}
+
+
+template<class TInputImage, class TMaskImage>
+void
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  // the objects may cross the whole image: all the inputs are required
+  for( unsigned int i=0; i<this->GetNumberOfInputs(); i++ )
+    {
+    if( this->ProcessObject::GetInput( i ) )
+      {
+      this->ProcessObject::GetInput( i )->SetRequestedRegionToLargestPossibleRegion();
+      }
+    }
+}
+
+
+template<class TInputImage, class TMaskImage>
+void
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::EnlargeOutputRequestedRegion(DataObject *data)
+{
+  Superclass::EnlargeOutputRequestedRegion(data);
+  data->SetRequestedRegionToLargestPossibleRegion();
+}
+
+
+template<class TInputImage, class TMaskImage>
+void
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::AllocateOutputs()
+{
+  // Pass the input through as the output
+  InputImagePointer image = const_cast< TInputImage * >( this->GetInput() );
+  this->GraftOutput( image );
+}
+
+
+template<class TInputImage, class TMaskImage>
+void
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::BeforeThreadedGenerateData()
+{
+  const RegionType & region = this->GetOutput()->GetRequestedRegion();
+  const SizeType & size = region.GetSize();
+
+  // the axis used to split the image in strips, chosen the same way as in
+  // ImageSource::SplitRequestedRegion()
+  m_SplitAxis = ImageDimension - 1;
+  while( m_SplitAxis > 0 && size[m_SplitAxis] == 1 )
+    {
+    m_SplitAxis--;
+    }
+
+  m_Strides.resize( ImageDimension );
+  m_Strides[0] = 1;
+  for( unsigned int d=1; d<ImageDimension; d++ )
+    {
+    m_Strides[d] = m_Strides[d-1] * size[d-1];
+    }
+  m_LayerSize = m_Strides[m_SplitAxis];
+
+  // the neighbors of a pixel already visited in raster order, and the ones in
+  // the previous layer, used to merge the strips. The neighbors on the axes
+  // after the split axis are always outside of the image.
+  m_PreviousNeighbors.clear();
+  m_PreviousDistances.clear();
+  m_BorderNeighbors.clear();
+  unsigned long numberOfOffsets = 1;
+  for( unsigned int d=0; d<=m_SplitAxis; d++ )
+    {
+    numberOfOffsets *= 3;
+    }
+  for( unsigned long k=0; k<numberOfOffsets; k++ )
+    {
+    OffsetType offset;
+    offset.Fill( 0 );
+    unsigned long r = k;
+    unsigned int nonZero = 0;
+    for( unsigned int d=0; d<=m_SplitAxis; d++ )
+      {
+      offset[d] = static_cast< long >( r % 3 ) - 1;
+      r /= 3;
+      if( offset[d] != 0 )
+        {
+        nonZero++;
+        }
+      }
+    if( nonZero == 0 || ( !m_FullyConnected && nonZero > 1 ) )
+      {
+      continue;
+      }
+    // the neighbor is visited before the pixel if its last non zero
+    // component is negative
+    int d = m_SplitAxis;
+    while( offset[d] == 0 )
+      {
+      d--;
+      }
+    if( offset[d] < 0 )
+      {
+      long distance = 0;
+      for( unsigned int i=0; i<=m_SplitAxis; i++ )
+        {
+        distance -= offset[i] * static_cast< long >( m_Strides[i] );
+        }
+      m_PreviousNeighbors.push_back( offset );
+      m_PreviousDistances.push_back( distance );
+      }
+    if( offset[m_SplitAxis] == -1 )
+      {
+      m_BorderNeighbors.push_back( offset );
+      }
+    }
+
+  int numberOfThreads = this->GetNumberOfThreads();
+  m_ThreadData.clear();
+  m_ThreadData.resize( numberOfThreads );
+  for( int t=0; t<numberOfThreads; t++ )
+    {
+    // label 0 is the background
+    for( unsigned int c=0; c<2; c++ )
+      {
+      m_ThreadData[t].Parent[c].assign( 1, 0 );
+      m_ThreadData[t].Sizes[c].assign( 1, 0 );
+      }
+    }
+}
+
+
+template<class TInputImage, class TMaskImage>
+void
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::ThreadedGenerateData(const RegionType& outputRegionForThread, int threadId)
+{
+  ThreadData & data = m_ThreadData[threadId];
+  data.Region = outputRegionForThread;
+
+  unsigned long numberOfPixels = outputRegionForThread.GetNumberOfPixels();
+  ProgressReporter progress( this, threadId, numberOfPixels );
+
+  // the neighbors already visited are at most a layer and a line away, so
+  // two layers are enough in the rolling buffer
+  for( unsigned int c=0; c<2; c++ )
+    {
+    data.Buffer[c].resize( 2 * m_LayerSize );
+    data.FirstLayer[c].resize( m_LayerSize );
+    data.LastLayer[c].resize( m_LayerSize );
+    }
+  unsigned long bufferSize = 2 * m_LayerSize;
+
+  const IndexType & start = outputRegionForThread.GetIndex();
+  const SizeType & size = outputRegionForThread.GetSize();
+
+  typedef ImageRegionConstIteratorWithIndex< InputImageType > IteratorWithIndexType;
+  typedef ImageRegionConstIterator< InputImageType > IteratorType;
+  typedef ImageRegionConstIterator< MaskImageType > MaskIteratorType;
+
+  IteratorWithIndexType it0( this->GetInput( 0 ), outputRegionForThread );
+  IteratorType it1( this->GetInput( 1 ), outputRegionForThread );
+
+  const MaskImageType * mask = this->GetMaskImage();
+  MaskIteratorType mit;
+  if( mask )
+    {
+    mit = MaskIteratorType( mask, outputRegionForThread );
+    mit.GoToBegin();
+    }
+
+  // most overlapping pixels are in runs of the same pair of labels: count
+  // them before updating the overlap map
+  LabelPairType lastPair( 0, 0 );
+  unsigned long lastCount = 0;
+
+  unsigned long position = 0;
+  for( it0.GoToBegin(), it1.GoToBegin(); !it0.IsAtEnd(); ++it0, ++it1, position++ )
+    {
+    LabelType label0 = 0;
+    LabelType label1 = 0;
+    if( !mask || mit.Get() == m_MaskValue )
+      {
+      bool fg0 = it0.Get() > m_Threshold[0];
+      bool fg1 = it1.Get() > m_Threshold[1];
+      if( fg0 || fg1 )
+        {
+        // all the neighbors of an interior pixel are in the strip
+        const IndexType & index = it0.GetIndex();
+        bool interior = true;
+        for( unsigned int d=0; d<=m_SplitAxis && interior; d++ )
+          {
+          interior = index[d] != start[d]
+            && ( d == m_SplitAxis || index[d] != start[d] + static_cast< long >( size[d] ) - 1 );
+          }
+        if( fg0 )
+          {
+          label0 = this->LabelPixel( 0, index, position, interior, data );
+          }
+        if( fg1 )
+          {
+          label1 = this->LabelPixel( 1, index, position, interior, data );
+          }
+        }
+      if( label0 && label1 )
+        {
+        LabelPairType pair( label0, label1 );
+        if( pair == lastPair )
+          {
+          lastCount++;
+          }
+        else
+          {
+          if( lastCount )
+            {
+            data.Overlaps[ lastPair ] += lastCount;
+            }
+          lastPair = pair;
+          lastCount = 1;
+          }
+        }
+      }
+    data.Buffer[0][ position % bufferSize ] = label0;
+    data.Buffer[1][ position % bufferSize ] = label1;
+    if( position < m_LayerSize )
+      {
+      data.FirstLayer[0][ position ] = label0;
+      data.FirstLayer[1][ position ] = label1;
+      }
+    if( mask )
+      {
+      ++mit;
+      }
+    progress.CompletedPixel();
+    }
+  if( lastCount )
+    {
+    data.Overlaps[ lastPair ] += lastCount;
+    }
+
+  // keep the last layer for the merge, and release the buffer
+  for( unsigned int c=0; c<2; c++ )
+    {
+    for( unsigned long i=0; i<m_LayerSize; i++ )
+      {
+      data.LastLayer[c][i] = data.Buffer[c][ ( numberOfPixels - m_LayerSize + i ) % bufferSize ];
+      }
+    LabelVectorType().swap( data.Buffer[c] );
+    }
+}
+
+
+template<class TInputImage, class TMaskImage>
+typename ObjectColocalizationImageFilter<TInputImage, TMaskImage>::LabelType
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::LabelPixel( unsigned int channel, const IndexType & index,
+              unsigned long position, bool interior, ThreadData & data )
+{
+  LabelVectorType & parent = data.Parent[channel];
+  const LabelVectorType & buffer = data.Buffer[channel];
+  unsigned long bufferSize = buffer.size();
+
+  LabelType label = 0;
+  for( unsigned int k=0; k<m_PreviousNeighbors.size(); k++ )
+    {
+    // don't look outside of the strip: the other threads may not have
+    // labeled it yet. The borders are merged after the threads are done.
+    if( !interior && !data.Region.IsInside( index + m_PreviousNeighbors[k] ) )
+      {
+      continue;
+      }
+    LabelType l = buffer[ ( position - m_PreviousDistances[k] ) % bufferSize ];
+    if( l )
+      {
+      if( !label )
+        {
+        label = l;
+        }
+      else
+        {
+        Union( parent, label, l );
+        }
+      }
+    }
+
+  if( !label )
+    {
+    // a new object
+    label = parent.size();
+    parent.push_back( label );
+    data.Sizes[channel].push_back( 0 );
+    }
+  data.Sizes[channel][label]++;
+  return label;
+}
+
+template<class TInputImage, class TMaskImage>
+typename ObjectColocalizationImageFilter<TInputImage, TMaskImage>::LabelType
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::FindRoot( LabelVectorType & parent, LabelType label )
+{
+  LabelType root = label;
+  while( parent[root] != root )
+    {
+    root = parent[root];
+    }
+  // path compression
+  while( parent[label] != root )
+    {
+    LabelType next = parent[label];
+    parent[label] = root;
+    label = next;
+    }
+  return root;
+}
+
+
+template<class TInputImage, class TMaskImage>
+void
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::Union( LabelVectorType & parent, LabelType label1, LabelType label2 )
+{
+  label1 = FindRoot( parent, label1 );
+  label2 = FindRoot( parent, label2 );
+  // keep the smallest label as root, so the root is always the first label
+  // seen in raster order
+  if( label1 < label2 )
+    {
+    parent[label2] = label1;
+    }
+  else if( label2 < label1 )
+    {
+    parent[label1] = label2;
+    }
+}
+
+
+template<class TInputImage, class TMaskImage>
+unsigned long
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::ComputeFinalLabels( unsigned int channel, LabelVectorType & base,
+                      LabelVectorType & finalLabels, SizeVectorType & sizes )
+{
+  unsigned int numberOfThreads = m_ThreadData.size();
+
+  // give each thread its own range of labels in a global union-find structure
+  base.resize( numberOfThreads );
+  LabelType total = 0;
+  for( unsigned int t=0; t<numberOfThreads; t++ )
+    {
+    base[t] = total;
+    total += m_ThreadData[t].Parent[channel].size() - 1;
+    }
+
+  LabelVectorType parent( total + 1 );
+  parent[0] = 0;
+  for( unsigned int t=0; t<numberOfThreads; t++ )
+    {
+    LabelVectorType & localParent = m_ThreadData[t].Parent[channel];
+    for( LabelType l=1; l<localParent.size(); l++ )
+      {
+      parent[ base[t] + l ] = base[t] + FindRoot( localParent, l );
+      }
+    }
+
+  // merge the objects crossing the strip borders, from the first layer of
+  // each strip and the last layer of the previous one
+  const RegionType & requestedRegion = this->GetOutput()->GetRequestedRegion();
+  const SizeType & requestedSize = requestedRegion.GetSize();
+  for( unsigned int t=0; t<numberOfThreads; t++ )
+    {
+    const RegionType & region = m_ThreadData[t].Region;
+    if( region.GetNumberOfPixels() == 0
+        || region.GetIndex()[m_SplitAxis] == requestedRegion.GetIndex()[m_SplitAxis] )
+      {
+      // this thread has not been used, or its strip is the first one
+      continue;
+      }
+    // find the previous strip
+    unsigned int p = 0;
+    while( m_ThreadData[p].Region.GetNumberOfPixels() == 0
+           || m_ThreadData[p].Region.GetIndex()[m_SplitAxis]
+              + static_cast< long >( m_ThreadData[p].Region.GetSize()[m_SplitAxis] )
+              != region.GetIndex()[m_SplitAxis] )
+      {
+      p++;
+      }
+    const LabelVectorType & firstLayer = m_ThreadData[t].FirstLayer[channel];
+    const LabelVectorType & lastLayer = m_ThreadData[p].LastLayer[channel];
+
+    for( unsigned long i=0; i<m_LayerSize; i++ )
+      {
+      if( !firstLayer[i] )
+        {
+        continue;
+        }
+      for( typename std::vector< OffsetType >::const_iterator oit = m_BorderNeighbors.begin();
+           oit != m_BorderNeighbors.end();
+           oit++ )
+        {
+        // position of the neighbor in the previous layer
+        long j = i;
+        bool inside = true;
+        for( unsigned int d=0; d<m_SplitAxis && inside; d++ )
+          {
+          long c = static_cast< long >( ( i / m_Strides[d] ) % requestedSize[d] ) + (*oit)[d];
+          inside = c >= 0 && c < static_cast< long >( requestedSize[d] );
+          j += (*oit)[d] * static_cast< long >( m_Strides[d] );
+          }
+        if( inside && lastLayer[j] )
+          {
+          Union( parent, base[t] + firstLayer[i], base[p] + lastLayer[j] );
+          }
+        }
+      }
+    }
+
+  // the roots get consecutive labels. A root is always smaller than the
+  // labels attached to it, so its final label is already known.
+  finalLabels.resize( total + 1 );
+  finalLabels[0] = 0;
+  LabelType numberOfObjects = 0;
+  for( LabelType l=1; l<=total; l++ )
+    {
+    LabelType root = FindRoot( parent, l );
+    if( root == l )
+      {
+      finalLabels[l] = ++numberOfObjects;
+      }
+    else
+      {
+      finalLabels[l] = finalLabels[root];
+      }
+    }
+
+  sizes.assign( numberOfObjects + 1, 0 );
+  for( unsigned int t=0; t<numberOfThreads; t++ )
+    {
+    SizeVectorType & localSizes = m_ThreadData[t].Sizes[channel];
+    for( LabelType l=1; l<localSizes.size(); l++ )
+      {
+      sizes[ finalLabels[ base[t] + l ] ] += localSizes[l];
+      }
+    }
+
+  return numberOfObjects;
+}
+
+
+template<class TInputImage, class TMaskImage>
+void
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::AfterThreadedGenerateData()
+{
+  LabelVectorType base0, base1;
+  LabelVectorType finalLabels0, finalLabels1;
+  m_NumberOfObjects1 = this->ComputeFinalLabels( 0, base0, finalLabels0, m_ObjectSizes1 );
+  m_NumberOfObjects2 = this->ComputeFinalLabels( 1, base1, finalLabels1, m_ObjectSizes2 );
+
+  // the overlap table, with the final labels
+  m_OverlapAreas.clear();
+  for( unsigned int t=0; t<m_ThreadData.size(); t++ )
+    {
+    const OverlapMapType & overlaps = m_ThreadData[t].Overlaps;
+    for( typename OverlapMapType::const_iterator it = overlaps.begin();
+         it != overlaps.end();
+         it++ )
+      {
+      LabelPairType pair( finalLabels0[ base0[t] + it->first.first ],
+                          finalLabels1[ base1[t] + it->first.second ] );
+      m_OverlapAreas[ pair ] += it->second;
+      }
+    }
+
+  // the object level coefficients
+  std::vector< bool > colocalized1( m_NumberOfObjects1 + 1, false );
+  std::vector< bool > colocalized2( m_NumberOfObjects2 + 1, false );
+  for( typename OverlapMapType::const_iterator it = m_OverlapAreas.begin();
+       it != m_OverlapAreas.end();
+       it++ )
+    {
+    colocalized1[ it->first.first ] = true;
+    colocalized2[ it->first.second ] = true;
+    }
+
+  unsigned long area1 = 0;
+  unsigned long colocalizedArea1 = 0;
+  m_NumberOfColocalizedObjects1 = 0;
+  for( LabelType l=1; l<=m_NumberOfObjects1; l++ )
+    {
+    area1 += m_ObjectSizes1[l];
+    if( colocalized1[l] )
+      {
+      colocalizedArea1 += m_ObjectSizes1[l];
+      m_NumberOfColocalizedObjects1++;
+      }
+    }
+
+  unsigned long area2 = 0;
+  unsigned long colocalizedArea2 = 0;
+  m_NumberOfColocalizedObjects2 = 0;
+  for( LabelType l=1; l<=m_NumberOfObjects2; l++ )
+    {
+    area2 += m_ObjectSizes2[l];
+    if( colocalized2[l] )
+      {
+      colocalizedArea2 += m_ObjectSizes2[l];
+      m_NumberOfColocalizedObjects2++;
+      }
+    }
+
+  m_ObjectOverlap1 = 0;
+  m_ObjectContribution1 = 0;
+  if( m_NumberOfObjects1 )
+    {
+    m_ObjectOverlap1 = m_NumberOfColocalizedObjects1 / (double)m_NumberOfObjects1;
+    m_ObjectContribution1 = colocalizedArea1 / (double)area1;
+    }
+
+  m_ObjectOverlap2 = 0;
+  m_ObjectContribution2 = 0;
+  if( m_NumberOfObjects2 )
+    {
+    m_ObjectOverlap2 = m_NumberOfColocalizedObjects2 / (double)m_NumberOfObjects2;
+    m_ObjectContribution2 = colocalizedArea2 / (double)area2;
+    }
+
+  // release the internal data
+  m_ThreadData.clear();
+}
+
+
+template<class TInputImage, class TMaskImage>
+void
+ObjectColocalizationImageFilter<TInputImage, TMaskImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "Threshold: " << m_Threshold << std::endl;
+  os << indent << "FullyConnected: " << m_FullyConnected << std::endl;
+  os << indent << "MaskValue: " << static_cast<typename NumericTraits<MaskPixelType>::PrintType>(m_MaskValue) << std::endl;
+  os << indent << "NumberOfObjects1: " << m_NumberOfObjects1 << std::endl;
+  os << indent << "NumberOfObjects2: " << m_NumberOfObjects2 << std::endl;
+  os << indent << "NumberOfColocalizedObjects1: " << m_NumberOfColocalizedObjects1 << std::endl;
+  os << indent << "NumberOfColocalizedObjects2: " << m_NumberOfColocalizedObjects2 << std::endl;
+  os << indent << "ObjectOverlap1: " << m_ObjectOverlap1 << std::endl;
+  os << indent << "ObjectOverlap2: " << m_ObjectOverlap2 << std::endl;
+  os << indent << "ObjectContribution1: " << m_ObjectContribution1 << std::endl;
+  os << indent << "ObjectContribution2: " << m_ObjectContribution2 << std::endl;
+}
+
+}// end namespace itk
+#endif